@@ -0,0 +1,82 @@
+#!/usr/bin/env bash
+# Flash/RAM-käyttö ominaisuuksittain.
+#
+# Pohjana on minimikokoonpano ilman UART-parseria ja nappeja. Parseri ja
+# napit mitataan pohjaan lisättyinä, muut ominaisuudet (joista osa vaatii
+# parserin) minimikokoonpanoon (minimal.conf) lisättyinä. Lopuksi
+# käännetään oletuskokoonpano. Jokaisesta tulostetaan koko ja ero
+# vertailukokoonpanoon. --detail ajaa lisäksi Zephyrin rom_report- ja
+# ram_report-kohteet oletuskokoonpanolle.
+#
+# Käyttö: scripts/footprint_report.sh [board] [--detail]
+set -euo pipefail
+
+APP_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+BOARD="${1:-nrf5340dk/nrf5340/cpuapp}"
+DETAIL="${2:-}"
+OUT_DIR="${APP_DIR}/build_footprint"
+
+BASE_FEATURES=(APP_UART_PARSER APP_BUTTONS)
+FEATURES=(APP_DEBUG APP_TIMING APP_LOGGING APP_EVENT_RECORDER APP_UART_HIGH_SPEED APP_CPU_STATS APP_SCHEDULE)
+# Ominaisuuden vaatimat lisäasetukset. minimal.conf kytkee TRACING_USERin
+# pois, jotta Kconfig ei varoita ilman CPU-tilastoja.
+declare -A FEATURE_EXTRA=([APP_CPU_STATS]="-DCONFIG_TRACING_USER=y")
+
+# Linkkerin --print-memory-usage -rivit tavuiksi
+region_bytes() {
+    awk -v r="$1:" '$1 == r {
+        v = $2
+        if ($3 == "KB") v *= 1024
+        else if ($3 == "MB") v *= 1024 * 1024
+        print v
+        exit
+    }' "$2"
+}
+
+build() {
+    local name="$1"
+    shift
+    local dir="${OUT_DIR}/${name}"
+    west build -p always -b "${BOARD}" -d "${dir}" "${APP_DIR}" -- "$@" > "${dir}.log" 2>&1 \
+        || { echo "${name}: build failed, see ${dir}.log" >&2; exit 1; }
+    echo "$(region_bytes FLASH "${dir}.log") $(region_bytes RAM "${dir}.log")"
+}
+
+mkdir -p "${OUT_DIR}"
+
+report() {
+    printf "%-22s %10d %10d %+10d %+10d  vs %s\n" "$1" "$2" "$3" $(($2 - $4)) $(($3 - $5)) "$6"
+}
+
+# Pohja: minimal.conf ilman parseria ja nappeja. Parserista riippuvat
+# asetukset jätetään pois, jotta Kconfig ei varoita.
+BASE_CONF="${OUT_DIR}/baseline.conf"
+grep -v '^CONFIG_APP_UART_LINE_MAX' "${APP_DIR}/minimal.conf" > "${BASE_CONF}"
+printf 'CONFIG_APP_UART_PARSER=n\nCONFIG_APP_BUTTONS=n\n' >> "${BASE_CONF}"
+
+printf "%-22s %10s %10s %10s %10s\n" "profile" "flash" "ram" "+flash" "+ram"
+
+read -r base_flash base_ram < <(build baseline "-DEXTRA_CONF_FILE=${BASE_CONF}")
+printf "%-22s %10d %10d %10s %10s\n" "baseline" "${base_flash}" "${base_ram}" "-" "-"
+
+for feature in "${BASE_FEATURES[@]}"; do
+    read -r flash ram < <(build "${feature}" "-DEXTRA_CONF_FILE=${BASE_CONF}" "-DCONFIG_${feature}=y")
+    report "+${feature}" "${flash}" "${ram}" "${base_flash}" "${base_ram}" baseline
+done
+
+read -r min_flash min_ram < <(build minimal -DEXTRA_CONF_FILE=minimal.conf)
+report "minimal" "${min_flash}" "${min_ram}" "${base_flash}" "${base_ram}" baseline
+
+for feature in "${FEATURES[@]}"; do
+    read -r flash ram < <(build "${feature}" -DEXTRA_CONF_FILE=minimal.conf "-DCONFIG_${feature}=y" \
+        ${FEATURE_EXTRA[${feature}]:-})
+    report "+${feature}" "${flash}" "${ram}" "${min_flash}" "${min_ram}" minimal
+done
+
+read -r flash ram < <(build default)
+report "default" "${flash}" "${ram}" "${base_flash}" "${base_ram}" baseline
+
+if [ "${DETAIL}" = "--detail" ]; then
+    west build -d "${OUT_DIR}/default" -t rom_report
+    west build -d "${OUT_DIR}/default" -t ram_report
+fi
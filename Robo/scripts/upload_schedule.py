@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Lataa valo-ohjelman laitteelle paloina (#SB / #SC / #SE).
+
+Ohjelmatiedostossa on askeleita muodossa R,1000 Y,500 G,2000, välilyönnein
+tai rivinvaihdoin erotettuina. Jokainen pala odottaa kuittauksen.
+Kadonneen kuittauksen jälkeen pala lähetetään uudelleen; jos laite odottaa
+jo seuraavaa palaa (SEQ), pala meni perille. Sisällöltään virheellinen
+pala (STEP, FULL) keskeyttää latauksen heti (#SA).
+
+--fast-baud neuvottelee ensin suuremman nopeuden (#BAUD / #BAUD OK).
+Jos laite hylkää nopeuden tai vahvistus ei mene perille, isäntä palaa
+alkuperäiseen nopeuteen ja lataus jatkuu sillä.
+
+Käyttö: upload_schedule.py <portti> <ohjelma.txt> [--baud 115200] [--line 128]
+        [--fast-baud 1000000]
+"""
+import argparse
+import sys
+
+import serial
+
+
+def command(port, line, expect):
+    port.write((line + "\n").encode("ascii"))
+    while True:
+        reply = port.readline().decode("ascii", "replace").strip()
+        if not reply:
+            raise TimeoutError(f"no reply to {line!r}")
+        if reply.startswith(expect):
+            return reply
+
+
+def wait_line(port, expect):
+    while True:
+        reply = port.readline().decode("ascii", "replace").strip()
+        if not reply or reply.startswith(expect):
+            return reply
+
+
+def switch_baud(port, baud, fast_baud):
+    """Palauttaa True, jos nopeus vaihtui. Muuten portti on taas baud-nopeudessa."""
+    try:
+        reply = command(port, f"#BAUD {fast_baud}", "BAUD ")
+    except TimeoutError:
+        return False
+    if not reply.startswith("BAUD ACK"):
+        return False
+
+    port.baudrate = fast_baud
+    port.rtscts = True
+    port.reset_input_buffer()
+    try:
+        if command(port, "#BAUD OK", "BAUD ").startswith("BAUD OK"):
+            return True
+    except TimeoutError:
+        pass
+
+    # Laite palaa itse 115200:aan CONFIG_APP_UART_BAUD_TIMEOUT_MS jälkeen
+    port.baudrate = baud
+    port.rtscts = False
+    wait_line(port, "BAUD TIMEOUT")
+    port.reset_input_buffer()
+    return False
+
+
+def chunks(steps, line_max):
+    chunk = []
+    length = len("#SC 00000")
+    for step in steps:
+        if chunk and length + 1 + len(step) >= line_max:
+            yield chunk
+            chunk = []
+            length = len("#SC 00000")
+        chunk.append(step)
+        length += 1 + len(step)
+    if chunk:
+        yield chunk
+
+
+def abort(port, message):
+    try:
+        command(port, "#SA", "SA ")
+    except TimeoutError:
+        pass
+    sys.exit(message)
+
+
+def send_chunk(port, seq, chunk, retries):
+    line = f"#SC {seq} " + " ".join(chunk)
+    reply = f"no reply to chunk {seq}"
+    for _ in range(retries):
+        port.reset_input_buffer()
+        try:
+            reply = command(port, line, "SC ")
+        except TimeoutError:
+            # Kuittaus katosi, lähetetään sama pala uudelleen
+            continue
+        if reply.startswith("SC OK"):
+            return True, reply
+        # Pala meni perille, mutta sen kuittaus katosi
+        if reply == f"SC ERR {seq} SEQ {seq + 1}":
+            return True, reply
+        # STEP ja FULL toistuvat samoina, uusinta ei auta
+        if " STEP " in reply or reply.endswith(" FULL"):
+            break
+    return False, reply
+
+
+def upload(port, steps, args):
+    try:
+        reply = command(port, f"#SB {len(steps)}", "SB ")
+    except TimeoutError as e:
+        abort(port, str(e))
+    if not reply.startswith("SB OK"):
+        sys.exit(f"begin rejected: {reply}")
+
+    for seq, chunk in enumerate(chunks(steps, args.line)):
+        ok, reply = send_chunk(port, seq, chunk, args.retries)
+        if not ok:
+            abort(port, f"chunk {seq} rejected: {reply}")
+
+    try:
+        reply = command(port, f"#SE {len(steps)}", "SE ")
+    except TimeoutError as e:
+        abort(port, str(e))
+    if not reply.startswith("SE OK"):
+        abort(port, f"commit rejected: {reply}")
+    print(reply)
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("port")
+    ap.add_argument("schedule")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--line", type=int, default=128, help="CONFIG_APP_UART_LINE_MAX")
+    ap.add_argument("--retries", type=int, default=3)
+    ap.add_argument("--fast-baud", type=int, help="neuvoteltava nopeus, esim. 1000000")
+    args = ap.parse_args()
+
+    with open(args.schedule, encoding="ascii") as f:
+        steps = f.read().split()
+
+    with serial.Serial(args.port, args.baud, timeout=2) as port:
+        port.reset_input_buffer()
+        fast = False
+        if args.fast_baud:
+            fast = switch_baud(port, args.baud, args.fast_baud)
+            if not fast:
+                print(f"fast baud {args.fast_baud} failed, using {args.baud}", file=sys.stderr)
+
+        try:
+            upload(port, steps, args)
+        finally:
+            if fast:
+                command(port, "#BAUD RESET", "BAUD ")
+                port.baudrate = args.baud
+                port.rtscts = False
+
+
+if __name__ == "__main__":
+    main()
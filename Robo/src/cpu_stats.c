@@ -0,0 +1,180 @@
+// Säiekohtainen CPU-käyttö ja ylikuormituksen tunnistus
+//
+// Näytteistää k_thread_runtime_stats -laskurit jaksoittain ja säilyttää
+// viimeiset CONFIG_APP_CPU_STATS_WINDOW näytettä. "#CPU" tulostaa ikkunan,
+// "#CPU LIMIT <pct>" asettaa rajan. Kun säie ylittää rajan, tulostetaan
+// kerran "CPU OVERLOAD <säie> <pct>%", ja "CPU OK <säie>" kun se palaa alle.
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <string.h>
+
+#include "cpu_stats.h"
+#include "priorities.h"
+
+#define CPU_STACK_SIZE 768
+#define CPU_PERIOD_MS CONFIG_APP_CPU_STATS_PERIOD_MS
+#define CPU_WINDOW CONFIG_APP_CPU_STATS_WINDOW
+#define CPU_MAX_THREADS CONFIG_APP_CPU_STATS_MAX_THREADS
+
+struct cpu_thread {
+    const struct k_thread *thread;
+    uint64_t prev_cycles;
+    uint8_t pct[CPU_WINDOW];
+    bool overload;
+    bool seen;
+    bool fresh;
+};
+
+static struct cpu_thread threads[CPU_MAX_THREADS];
+static uint8_t idle_pct[CPU_WINDOW];
+static uint16_t switches[CPU_WINDOW];
+static uint32_t sample;
+
+static uint64_t prev_total;
+static uint64_t prev_idle;
+static uint64_t window_cycles;
+
+static volatile uint32_t switch_count;
+static uint32_t prev_switch_count;
+
+static uint8_t limit_pct = CONFIG_APP_CPU_OVERLOAD_PCT;
+
+K_MUTEX_DEFINE(cpu_mutex);
+
+#ifdef CONFIG_TRACING_USER
+// Kutsutaan skedulerista jokaisella kontekstin vaihdolla
+void sys_trace_thread_switched_in_user(void) {
+    switch_count++;
+}
+#endif
+
+void cpu_stats_set_limit(uint8_t pct) {
+    limit_pct = pct;
+}
+
+// ---------------- SAMPLING ----------------
+
+static struct cpu_thread *slot_for(const struct k_thread *thread) {
+    struct cpu_thread *free_slot = NULL;
+
+    for (int i = 0; i < CPU_MAX_THREADS; i++) {
+        if (threads[i].thread == thread) return &threads[i];
+        if (!threads[i].thread && !free_slot) free_slot = &threads[i];
+    }
+    if (free_slot) {
+        memset(free_slot, 0, sizeof(*free_slot));
+        free_slot->thread = thread;
+        free_slot->fresh = true;
+    }
+    return free_slot;
+}
+
+static void sample_thread(const struct k_thread *thread, void *user_data) {
+    uint32_t idx = *(uint32_t *)user_data;
+    k_thread_runtime_stats_t st;
+
+    // Idle-säie lasketaan erikseen koko järjestelmän tilastoista
+    if (k_thread_priority_get((k_tid_t)thread) == K_IDLE_PRIO) return;
+    if (k_thread_runtime_stats_get((k_tid_t)thread, &st) != 0) return;
+
+    struct cpu_thread *t = slot_for(thread);
+    if (!t) return;
+
+    // Uuden säikeen ensimmäinen näyte vain alustaa laskurin
+    uint64_t delta = t->fresh ? 0 : st.execution_cycles - t->prev_cycles;
+    t->prev_cycles = st.execution_cycles;
+    t->pct[idx] = window_cycles ? (uint8_t)MIN(delta * 100 / window_cycles, 100) : 0;
+    t->fresh = false;
+    t->seen = true;
+}
+
+static void check_overload(uint32_t idx) {
+    for (int i = 0; i < CPU_MAX_THREADS; i++) {
+        struct cpu_thread *t = &threads[i];
+        if (!t->thread) continue;
+
+        if (!t->overload && t->pct[idx] > limit_pct) {
+            t->overload = true;
+            printk("CPU OVERLOAD %s %u%%\n", k_thread_name_get((k_tid_t)t->thread), t->pct[idx]);
+        } else if (t->overload && t->pct[idx] <= limit_pct) {
+            t->overload = false;
+            printk("CPU OK %s\n", k_thread_name_get((k_tid_t)t->thread));
+        }
+    }
+}
+
+static void take_sample(void) {
+    k_thread_runtime_stats_t all;
+    uint32_t idx = sample % CPU_WINDOW;
+
+    k_thread_runtime_stats_all_get(&all);
+    window_cycles = all.execution_cycles - prev_total;
+    uint64_t idle = all.idle_cycles - prev_idle;
+    prev_total = all.execution_cycles;
+    prev_idle = all.idle_cycles;
+    idle_pct[idx] = window_cycles ? (uint8_t)MIN(idle * 100 / window_cycles, 100) : 0;
+
+    uint32_t sw = switch_count;
+    switches[idx] = (uint16_t)MIN((uint64_t)(sw - prev_switch_count) * 1000 / CPU_PERIOD_MS, UINT16_MAX);
+    prev_switch_count = sw;
+
+    k_mutex_lock(&cpu_mutex, K_FOREVER);
+    for (int i = 0; i < CPU_MAX_THREADS; i++) {
+        threads[i].seen = false;
+    }
+    k_thread_foreach_unlocked(sample_thread, &idx);
+    // Päättyneiden säikeiden paikat vapaiksi
+    for (int i = 0; i < CPU_MAX_THREADS; i++) {
+        if (threads[i].thread && !threads[i].seen) threads[i].thread = NULL;
+    }
+    check_overload(idx);
+    sample++;
+    k_mutex_unlock(&cpu_mutex);
+}
+
+void cpu_stats_task(void *, void *, void *) {
+    while (true) {
+        take_sample();
+        k_msleep(CPU_PERIOD_MS);
+    }
+}
+
+K_THREAD_DEFINE(cpu_stats_thread, CPU_STACK_SIZE, cpu_stats_task, NULL, NULL, NULL, PRIO_DIAG, 0, 0);
+
+// ---------------- REPORT ----------------
+
+static void window_stats(const uint8_t *pct, uint32_t n, uint32_t *avg, uint32_t *max) {
+    uint32_t sum = 0;
+    *max = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        sum += pct[i];
+        if (pct[i] > *max) *max = pct[i];
+    }
+    *avg = n ? sum / n : 0;
+}
+
+void cpu_stats_report(void) {
+    k_mutex_lock(&cpu_mutex, K_FOREVER);
+
+    uint32_t n = MIN(sample, CPU_WINDOW);
+    uint32_t last = (sample + CPU_WINDOW - 1) % CPU_WINDOW;
+    uint32_t avg, max, sw_sum = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        sw_sum += switches[i];
+    }
+    window_stats(idle_pct, n, &avg, &max);
+    printk("CPU window %u x %d ms idle %u%% avg %u%% switches %u/s avg %u/s limit %u%%\n",
+           n, CPU_PERIOD_MS, idle_pct[last], avg, switches[last], n ? sw_sum / n : 0, limit_pct);
+
+    for (int i = 0; i < CPU_MAX_THREADS; i++) {
+        struct cpu_thread *t = &threads[i];
+        if (!t->thread) continue;
+        window_stats(t->pct, n, &avg, &max);
+        printk("CPU %s now %u%% avg %u%% max %u%%%s\n", k_thread_name_get((k_tid_t)t->thread),
+               t->pct[last], avg, max, t->overload ? " OVERLOAD" : "");
+    }
+    printk("CPU END\n");
+
+    k_mutex_unlock(&cpu_mutex);
+}
@@ -0,0 +1,9 @@
+#ifndef CPU_STATS_H
+#define CPU_STATS_H
+
+#include <stdint.h>
+
+void cpu_stats_report(void);
+void cpu_stats_set_limit(uint8_t pct);
+
+#endif
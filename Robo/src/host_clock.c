@@ -0,0 +1,9 @@
+// native_sim: isäntäpuolen kello replay-viiveille (käännetään native_simulatoriin)
+#include <stdint.h>
+#include <time.h>
+
+uint64_t recorder_host_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
@@ -7,11 +7,25 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <zephyr/logging/log.h>
+#ifdef CONFIG_APP_TIMING
 #include <zephyr/timing/timing.h>
+#endif
+
+#include "pipeline.h"
+#include "recorder.h"
+#include "uart_speed.h"
+#include "uart_rx.h"
+#include "cpu_stats.h"
+#include "priorities.h"
+#include "schedule.h"
 
 #define THREAD_STACK_SIZE 500
-#define THREAD_PRIORITY 5
-#define UART_BUFFER_SIZE 20
+#define UART_STACK_SIZE 1024
+#define LED_WQ_STACK_SIZE 512
+#define LED_STEP_MS 1000
+#define UART_BUFFER_SIZE CONFIG_APP_UART_LINE_MAX
+#define PIPELINE_DEPTH CONFIG_APP_PIPELINE_DEPTH
 
 #define TIME_PARSE_LEN_ERROR -1
 #define TIME_PARSE_VALUE_ERROR -3
@@ -19,6 +33,8 @@
 #define TIME_PARSE_NULL_ERROR -5
 #define TIME_PARSE_NONDIGIT_ERROR -6
 
+LOG_MODULE_REGISTER(traffic_light, LOG_LEVEL_INF);
+
 #define UART_DEVICE_NODE DT_CHOSEN(zephyr_shell_uart)
 #define BTN_RED DT_ALIAS(sw0)
 #define BTN_YELLOW DT_ALIAS(sw1)
@@ -26,12 +42,15 @@
 #define BTN_DEBUG DT_ALIAS(sw3)
 #define BTN_RESERVED DT_ALIAS(sw4)
 
+#ifdef CONFIG_APP_UART_PARSER
 static const struct device *const uart_dev = DEVICE_DT_GET(UART_DEVICE_NODE);
+#endif
 
 static const struct gpio_dt_spec red = GPIO_DT_SPEC_GET(DT_ALIAS(led0), gpios);
 static const struct gpio_dt_spec green = GPIO_DT_SPEC_GET(DT_ALIAS(led1), gpios);
 static const struct gpio_dt_spec blue = GPIO_DT_SPEC_GET(DT_ALIAS(led2), gpios);
 
+#ifdef CONFIG_APP_BUTTONS
 static const struct gpio_dt_spec btn_red = GPIO_DT_SPEC_GET_OR(BTN_RED, gpios, {0});
 static const struct gpio_dt_spec btn_yellow = GPIO_DT_SPEC_GET_OR(BTN_YELLOW, gpios, {0});
 static const struct gpio_dt_spec btn_green = GPIO_DT_SPEC_GET_OR(BTN_GREEN, gpios, {0});
@@ -43,23 +62,31 @@ static struct gpio_callback cb_btn_yellow;
 static struct gpio_callback cb_btn_green;
 static struct gpio_callback cb_btn_debug;
 static struct gpio_callback cb_btn_reserved;
+#endif
 
 K_FIFO_DEFINE(data_fifo);
-K_SEM_DEFINE(red_sem, 0, 1);
-K_SEM_DEFINE(yellow_sem, 0, 1);
-K_SEM_DEFINE(green_sem, 0, 1);
 K_SEM_DEFINE(release_sem, 0, 1);
-K_SEM_DEFINE(debug_sem, 0, 1);
+#ifdef CONFIG_APP_DEBUG
+// Aikaleimat debug-säikeelle; täysi jono pudottaa tulosteen eikä jarruta dispatcheria
+K_MSGQ_DEFINE(debug_msgq, sizeof(uint64_t), 4, 8);
+#endif
 
 struct data_t {
     void *fifo_reserved;
     char seq[10];
     int len;
     uint64_t time;
+    uint32_t stamp;
+    uint16_t duration;
+    uint8_t source;
 };
 
+// Kiinteä allokaattori k_mallocin sijaan: ISR-turvallinen eikä vaadi heappia
+K_MEM_SLAB_DEFINE(data_slab, sizeof(struct data_t), PIPELINE_DEPTH, 4);
+
 // ---------------- TIME PARSER ----------------
 
+#ifdef CONFIG_APP_UART_PARSER
 int time_parse(const char *time) {
     if (!time) return TIME_PARSE_NULL_ERROR;
     if (strlen(time) != 6) return TIME_PARSE_LEN_ERROR;
@@ -81,15 +108,18 @@ int time_parse(const char *time) {
 
     return total_sec;
 }
+#endif
 
 // ---------------- INIT FUNCTIONS ----------------
 
+#ifdef CONFIG_APP_UART_PARSER
 int init_uart(void) {
     if (!device_is_ready(uart_dev)) {
         return 1;
     }
     return 0;
 }
+#endif
 
 int init_leds(void) {
     int r = gpio_pin_configure_dt(&red, GPIO_OUTPUT_ACTIVE);
@@ -101,16 +131,35 @@ int init_leds(void) {
     return r;
 }
 
+// ---------------- PIPELINE INPUT ----------------
+
+int pipeline_submit_step(uint8_t source, char c, uint16_t duration_ms) {
+    struct data_t *item;
+    if (k_mem_slab_alloc(&data_slab, (void **)&item, K_NO_WAIT) != 0) return -1;
+
+    item->seq[0] = c;
+    item->len = 1;
+    item->time = k_uptime_get();
+    item->duration = duration_ms;
+    item->source = source;
+#ifdef CONFIG_APP_EVENT_RECORDER
+    item->stamp = recorder_stamp();
+    // Ohjelman askeleet eivät ole syötteitä, niitä ei tallenneta
+    if (source != REC_SRC_SCHEDULE) recorder_capture(source, c);
+#endif
+    k_fifo_put(&data_fifo, item);
+    return 0;
+}
+
+int pipeline_submit(uint8_t source, char c) {
+    return pipeline_submit_step(source, c, LED_STEP_MS);
+}
+
 // ---------------- BUTTON HANDLERS ----------------
 
+#ifdef CONFIG_APP_BUTTONS
 void button_add_char(char c) {
-    struct data_t *item = k_malloc(sizeof(struct data_t));
-    if (item) {
-        item->seq[0] = c;
-        item->len = 1;
-        item->time = k_uptime_get();
-        k_fifo_put(&data_fifo, item);
-    }
+    pipeline_submit(REC_SRC_BUTTON, c);
 }
 
 void btn_red_handler(const struct device *dev, struct gpio_callback *cb, uint32_t pins) {
@@ -142,164 +191,317 @@ int init_buttons(void) {
 
     for (int i = 0; i < 5; i++) {
         if (!gpio_is_ready_dt(&buttons[i])) {
-            printk("Button %d not ready\n", i);
+            LOG_ERR("Button %d not ready", i);
             return -1;
         }
         if (gpio_pin_configure_dt(&buttons[i], GPIO_INPUT) != 0) {
-            printk("Button %d config failed\n", i);
+            LOG_ERR("Button %d config failed", i);
             return -1;
         }
         if (gpio_pin_interrupt_configure_dt(&buttons[i], GPIO_INT_EDGE_TO_ACTIVE) != 0) {
-            printk("Button %d interrupt failed\n", i);
+            LOG_ERR("Button %d interrupt failed", i);
             return -1;
         }
         gpio_init_callback(callbacks[i], handlers[i], BIT(buttons[i].pin));
         gpio_add_callback(buttons[i].port, callbacks[i]);
     }
-    printk("All buttons initialized\n");
+    LOG_INF("All buttons initialized");
     return 0;
 }
+#endif
+
+// ---------------- LED STEPS ----------------
+
+// LED-askel on kaksi siirtymää samassa työkohteessa: päälle heti ja pois
+// keston jälkeen. Työjono on kooperatiivinen, joten siirtymät eivät jää
+// diagnostiikan tai UARTin taakse. Kummankin siirtymän myöhästyminen
+// suunnitellusta hetkestä kirjataan (#LAT).
+K_THREAD_STACK_DEFINE(led_wq_stack, LED_WQ_STACK_SIZE);
+static struct k_work_q led_wq;
+
+struct led_step {
+    struct k_work_delayable work;
+    char color;
+    uint32_t duration_ms;
+    uint32_t due;
+    bool on;
+};
 
-// ---------------- THREAD TASKS ----------------
+static struct led_step led_step;
+static uint32_t step_lat_max;
+static uint32_t step_count;
 
-void led_red_task(void *, void *, void *) {
-    while (true) {
-        k_sem_take(&red_sem, K_FOREVER);
-        gpio_pin_set_dt(&red, 1);
-        k_sleep(K_MSEC(1000));
-        gpio_pin_set_dt(&red, 0);
-        k_sem_give(&release_sem);
-        k_yield();
-        printk("Red led task running\n");
-    }
+static void led_set_color(char color) {
+    gpio_pin_set_dt(&red, color == 'R' || color == 'Y');
+    gpio_pin_set_dt(&green, color == 'G' || color == 'Y');
 }
 
-void led_yellow_task(void *, void *, void *) {
-    while (true) {
-        k_sem_take(&yellow_sem, K_FOREVER);
-        gpio_pin_set_dt(&red, 1);
-        gpio_pin_set_dt(&green, 1);
-        k_sleep(K_MSEC(1000));
-        gpio_pin_set_dt(&red, 0);
-        gpio_pin_set_dt(&green, 0);
+static void led_step_handler(struct k_work *work) {
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct led_step *step = CONTAINER_OF(dwork, struct led_step, work);
+
+    uint32_t lat = k_cycle_get_32() - step->due;
+    if (lat > step_lat_max) step_lat_max = lat;
+
+    if (!step->on) {
+        led_set_color(step->color);
+        step->on = true;
+        step->due = k_cycle_get_32() + k_ms_to_cyc_ceil32(step->duration_ms);
+        k_work_schedule_for_queue(&led_wq, &step->work, K_MSEC(step->duration_ms));
+    } else {
+        led_set_color(0);
+        step->on = false;
+        // Askel lasketaan kerran, kun se on päättynyt
+        step_count++;
         k_sem_give(&release_sem);
     }
 }
 
-void led_green_task(void *, void *, void *) {
-    while (true) {
-        k_sem_take(&green_sem, K_FOREVER);
-        gpio_pin_set_dt(&green, 1);
-        k_sleep(K_MSEC(1000));
-        gpio_pin_set_dt(&green, 0);
-        k_sem_give(&release_sem);
+static void led_step_start(char color, uint32_t duration_ms) {
+    led_step.color = color;
+    led_step.duration_ms = duration_ms;
+    led_step.on = false;
+    led_step.due = k_cycle_get_32();
+    k_work_schedule_for_queue(&led_wq, &led_step.work, K_NO_WAIT);
+}
+
+void init_led_steps(void) {
+    const struct k_work_queue_config cfg = {.name = "led_wq"};
+
+    k_work_init_delayable(&led_step.work, led_step_handler);
+    k_work_queue_init(&led_wq);
+    k_work_queue_start(&led_wq, led_wq_stack, K_THREAD_STACK_SIZEOF(led_wq_stack), PRIO_LED, &cfg);
+}
+
+// ---------------- UART COMMANDS ----------------
+
+#ifdef CONFIG_APP_UART_PARSER
+// '#'-alkuiset rivit ovat ohjauskomentoja, eivät aikamerkkijonoja
+static void uart_command(const char *cmd) {
+    if (strcmp(cmd, "LAT") == 0) {
+        printk("LAT max %u us steps %u\n", k_cyc_to_us_ceil32(step_lat_max), step_count);
+        return;
+    }
+    if (strcmp(cmd, "LAT RESET") == 0) {
+        step_lat_max = 0;
+        step_count = 0;
+        printk("LAT OK\n");
+        return;
+    }
+#ifdef CONFIG_APP_EVENT_RECORDER
+    if (strcmp(cmd, "RD") == 0) {
+        recorder_dump();
+    } else if (strcmp(cmd, "RC") == 0) {
+        recorder_clear();
+        printk("RC OK\n");
+    } else if (strncmp(cmd, "RL", 2) == 0) {
+        printk("RL %s\n", recorder_load_hex(cmd + 2) == 0 ? "OK" : "ERR");
+    } else if (strcmp(cmd, "RP") == 0 || strcmp(cmd, "RF") == 0) {
+        if (recorder_replay(cmd[1] == 'P') != 0) printk("RP BUSY\n");
+    } else
+#endif
+#ifdef CONFIG_APP_SCHEDULE
+    if (cmd[0] == 'S' && cmd[1] != '\0' && (cmd[2] == ' ' || cmd[2] == '\0')) {
+        schedule_command(cmd);
+    } else
+#endif
+#ifdef CONFIG_APP_CPU_STATS
+    if (strcmp(cmd, "CPU") == 0) {
+        cpu_stats_report();
+    } else if (strncmp(cmd, "CPU LIMIT ", 10) == 0) {
+        char *end;
+        unsigned long pct = strtoul(cmd + 10, &end, 10);
+        // Koko loppuosan on oltava numero väliltä 1..100
+        if (end == cmd + 10 || *end != '\0' || pct < 1 || pct > 100) {
+            printk("CPU LIMIT ERR\n");
+        } else {
+            cpu_stats_set_limit((uint8_t)pct);
+            printk("CPU LIMIT OK\n");
+        }
+    } else
+#endif
+#ifdef CONFIG_APP_UART_HIGH_SPEED
+    if (strcmp(cmd, "BAUD RESET") == 0) {
+        printk("BAUD ACK 115200\n");
+        uart_speed_reset(uart_dev);
+    } else if (strncmp(cmd, "BAUD ", 5) == 0) {
+        char *end;
+        unsigned long baud = strtoul(cmd + 5, &end, 10);
+        // Alue tarkistetaan uart_speed_switchissä
+        if (end == cmd + 5 || *end != '\0') {
+            printk("BAUD ERR\n");
+        } else {
+            uart_speed_switch(uart_dev, baud);
+        }
+    } else
+#endif
+    {
+        printk("Unknown command: %s\n", cmd);
     }
 }
 
+static bool is_pipeline_char(char c) {
+    c = toupper((unsigned char)c);
+    return c == 'R' || c == 'Y' || c == 'G' || (IS_ENABLED(CONFIG_APP_DEBUG) && c == 'D');
+}
+
 // ---------------- UART TASK (Päivitetty) ----------------
 
 void uart_task(void *, void *, void *) {
     char rc = 0;
-    char uart_msg[UART_BUFFER_SIZE];
+    static char uart_msg[UART_BUFFER_SIZE];
     int uart_msg_cnt = 0;
+    bool overflow = false;
 
     while (true) {
-        if (uart_poll_in(uart_dev, &rc) == 0) {
-            if (rc == '\r' || rc == '\n') {
-                if (uart_msg_cnt > 0) {
-                    uart_msg[uart_msg_cnt] = '\0';
+#ifdef CONFIG_APP_UART_IRQ_RX
+        if (uart_rx_get(&rc, K_FOREVER) != 0) continue;
+#else
+        // Luetaan kaikki saatavilla olevat merkit ennen nukkumista
+        if (uart_poll_in(uart_dev, &rc) != 0) {
+            k_msleep(10);
+            continue;
+        }
+#endif
+
+        if (rc == '\r' || rc == '\n') {
+            if (overflow) {
+                // Liian pitkä rivi hylätään kokonaan, ei katkaista
+                printk("ERR LINE %d\n", UART_BUFFER_SIZE - 1);
+                overflow = false;
+            } else if (uart_msg_cnt > 0) {
+                uart_msg[uart_msg_cnt] = '\0';
+                if (uart_msg[0] == '#') {
+                    uart_command(uart_msg + 1);
+                } else if (uart_msg_cnt == 1 && is_pipeline_char(uart_msg[0])) {
+                    if (pipeline_submit(REC_SRC_UART, uart_msg[0]) != 0) {
+                        LOG_WRN("Pipeline full, dropped %c", uart_msg[0]);
+                    }
+                } else {
                     int ret = time_parse(uart_msg);
                     printk("%d\n", ret);  // Robot Framework lukee tämän rivin
-                    uart_msg_cnt = 0;
-                    memset(uart_msg, 0, sizeof(uart_msg));
                 }
+            }
+            uart_msg_cnt = 0;
+            memset(uart_msg, 0, sizeof(uart_msg));
+        } else {
+            if (uart_msg_cnt < UART_BUFFER_SIZE - 1) {
+                uart_msg[uart_msg_cnt++] = rc;
             } else {
-                if (uart_msg_cnt < UART_BUFFER_SIZE - 1) {
-                    uart_msg[uart_msg_cnt++] = rc;
-                }
+                overflow = true;
             }
         }
-        k_msleep(10);
     }
 }
+#endif
 
 void dispatcher_task(void *, void *, void *) {
     while (true) {
         struct data_t *rec_item = k_fifo_get(&data_fifo, K_FOREVER);
+#ifdef CONFIG_APP_EVENT_RECORDER
+        uint32_t dequeued = recorder_stamp();
+#endif
 
         for (int i = 0; i < rec_item->len; i++) {
             char c = rec_item->seq[i];
+            bool wait = true;
 
             if (c >= 'a' && c <= 'z') c = c - 'a' + 'A';
 
             switch (c) {
                 case 'R':
-                    k_sem_give(&red_sem);
-                    break;
                 case 'Y':
-                    k_sem_give(&yellow_sem);
-                    break;
                 case 'G':
-                    k_sem_give(&green_sem);
+                    led_step_start(c, rec_item->duration);
                     break;
+#ifdef CONFIG_APP_DEBUG
                 case 'D':
-                    k_sem_give(&debug_sem);
+                    // Tulostus jää PRIO_DIAG-säikeelle, dispatcher ei odota sitä
+                    k_msgq_put(&debug_msgq, &rec_item->time, K_NO_WAIT);
+                    wait = false;
                     break;
+#endif
                 default:
-                    printk("Was given wrong char, give a new one\n");
+                    // Vain LED-askel vapauttaa release_semin
+                    LOG_WRN("Was given wrong char, give a new one");
+                    wait = false;
                     break;
             }
-            k_sem_take(&release_sem, K_FOREVER);
+#ifdef CONFIG_APP_EVENT_RECORDER
+            // LED-työjono on kooperatiivinen ja ajaa päällekytkennän ennen
+            // kuin led_step_start palaa, joten viive mitataan tässä eikä
+            // vasta askeleen päätyttyä
+            if (i == 0) recorder_note_latency(rec_item->source, rec_item->stamp, dequeued);
+#endif
+            if (wait) k_sem_take(&release_sem, K_FOREVER);
         }
 
-        k_free(rec_item);
+#ifdef CONFIG_APP_SCHEDULE
+        if (rec_item->source == REC_SRC_SCHEDULE) schedule_step_done();
+#endif
+        k_mem_slab_free(&data_slab, rec_item);
     }
 }
 
+#ifdef CONFIG_APP_DEBUG
 void debug_task(void *, void *, void *) {
     while (true) {
-        k_sem_take(&debug_sem, K_FOREVER);
-
-        struct data_t *received = k_fifo_get(&data_fifo, K_FOREVER);
-        if (received) {
-            printk("Debug received: %lld\n", received->time);
-            k_free(received);
-        }
-
-        k_sem_give(&release_sem);
-        k_yield();
+        uint64_t time;
+        k_msgq_get(&debug_msgq, &time, K_FOREVER);
+        printk("Debug received: %lld\n", time);
     }
 }
+#endif
 
-K_THREAD_DEFINE(red_thread, THREAD_STACK_SIZE, led_red_task, NULL, NULL, NULL, THREAD_PRIORITY, 0, 0);
-K_THREAD_DEFINE(yellow_thread, THREAD_STACK_SIZE, led_yellow_task, NULL, NULL, NULL, THREAD_PRIORITY, 0, 0);
-K_THREAD_DEFINE(green_thread, THREAD_STACK_SIZE, led_green_task, NULL, NULL, NULL, THREAD_PRIORITY, 0, 0);
-K_THREAD_DEFINE(uart_thread, THREAD_STACK_SIZE, uart_task, NULL, NULL, NULL, THREAD_PRIORITY, 0, 0);
-K_THREAD_DEFINE(dispatcher_thread, THREAD_STACK_SIZE, dispatcher_task, NULL, NULL, NULL, THREAD_PRIORITY, 0, 0);
-K_THREAD_DEFINE(debug_thread, THREAD_STACK_SIZE, debug_task, NULL, NULL, NULL, THREAD_PRIORITY, 0, 0);
+#ifdef CONFIG_APP_UART_PARSER
+K_THREAD_DEFINE(uart_thread, UART_STACK_SIZE, uart_task, NULL, NULL, NULL, PRIO_PARSER, 0, 0);
+#endif
+K_THREAD_DEFINE(dispatcher_thread, THREAD_STACK_SIZE, dispatcher_task, NULL, NULL, NULL, PRIO_DISPATCHER, 0, 0);
+#ifdef CONFIG_APP_DEBUG
+K_THREAD_DEFINE(debug_thread, THREAD_STACK_SIZE, debug_task, NULL, NULL, NULL, PRIO_DIAG, 0, 0);
+#endif
 
 // ---------------- MAIN ----------------
 
 int main(void) {
+    init_led_steps();
+
+#ifdef CONFIG_APP_UART_PARSER
     if (init_uart() != 0) {
-        printk("UART initialization failed\n");
+        LOG_ERR("UART initialization failed");
+        return 1;
+    }
+#endif
+#ifdef CONFIG_APP_UART_IRQ_RX
+    if (uart_rx_init(uart_dev) != 0) {
+        LOG_ERR("UART RX interrupt setup failed");
         return 1;
     }
+#endif
+#ifdef CONFIG_APP_UART_HIGH_SPEED
+    uart_speed_init(uart_dev);
+#endif
 
+#ifdef CONFIG_APP_TIMING
     timing_init();
     timing_start();
     timing_t start_time = timing_counter_get();
+#endif
 
     k_msleep(100);
     init_leds();
+#ifdef CONFIG_APP_BUTTONS
     init_buttons();
+#endif
 
-    printk("Program started..\n");
+    LOG_INF("Program started..");
 
+#ifdef CONFIG_APP_TIMING
     timing_t end_time = timing_counter_get();
     timing_stop();
     uint64_t timing_ns = timing_cycles_to_ns(timing_cycles_get(&start_time, &end_time));
     printk("Initialization: %lld ns\n", timing_ns);
+#endif
 
     while (1) k_sleep(K_MSEC(100));
 
@@ -0,0 +1,11 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+
+// Syöttää yhden komentomerkin dispatcherille (ISR-turvallinen)
+int pipeline_submit(uint8_t source, char c);
+// Kuten yllä, mutta LED-askeleen kesto annetaan
+int pipeline_submit_step(uint8_t source, char c, uint16_t duration_ms);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef PRIORITIES_H
+#define PRIORITIES_H
+
+#include <zephyr/kernel.h>
+
+// Säikeiden prioriteettitasot, pienempi numero on kiireellisempi.
+//
+// LED-ajoitus ajetaan kooperatiivisessa työjonossa, jota mikään
+// sovelluksen säie ei keskeytä. Pipeline (dispatcher, UART-parseri ja
+// tallenteen toisto) on keskellä ja diagnostiikka (debug, CPU-tilastot,
+// lokisäie) alimpana, jotta printk ei viivästytä valon vaihtoa.
+#define PRIO_LED        K_PRIO_COOP(2)
+#define PRIO_DISPATCHER K_PRIO_PREEMPT(4)
+#define PRIO_PARSER     K_PRIO_PREEMPT(6)
+#define PRIO_DIAG       K_PRIO_PREEMPT(10)
+
+#endif
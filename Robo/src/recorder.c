@@ -0,0 +1,226 @@
+// Syötetapahtumien tallennus ja uudelleentoisto (record & replay)
+//
+// Jokainen pipelineen tuleva tapahtuma (lähde, merkki, µs-aikaleima)
+// tallennetaan rengaspuskuriin. Puskurin voi tyhjentää UARTiin heksana
+// ("#RD"), ladata takaisin rivi kerrallaan ("#RL") ja toistaa joko
+// alkuperäisellä ajoituksella ("#RP") tai niin nopeasti kuin mahdollista
+// ("#RF"). Toiston lopuksi tulostetaan dispatch-viive (jonosta otosta
+// LED-askeleen käynnistykseen) ja jonossa odotettu aika erikseen.
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <string.h>
+
+#include "recorder.h"
+#include "pipeline.h"
+#include "priorities.h"
+
+#define REC_SIZE CONFIG_APP_EVENT_RECORDER_SIZE
+#define REC_HEX_LEN 12
+#define REPLAY_STACK_SIZE 768
+#define REPLAY_TIMEOUT_MS 5000
+
+static struct rec_event rec_ring[REC_SIZE];
+static uint32_t rec_head;
+static uint32_t rec_count;
+static struct k_spinlock rec_lock;
+
+static volatile bool replay_active;
+static bool replay_realtime;
+
+static uint32_t lat_count;
+static uint32_t lat_min;
+static uint32_t lat_max;
+static uint64_t lat_sum;
+static uint32_t queue_max;
+static uint64_t queue_sum;
+
+K_SEM_DEFINE(replay_start_sem, 0, 1);
+K_SEM_DEFINE(replay_done_sem, 0, K_SEM_MAX_LIMIT);
+
+// ---------------- RING BUFFER ----------------
+
+static void ring_put(const struct rec_event *ev) {
+    k_spinlock_key_t key = k_spin_lock(&rec_lock);
+    rec_ring[rec_head] = *ev;
+    rec_head = (rec_head + 1) % REC_SIZE;
+    if (rec_count < REC_SIZE) rec_count++;
+    k_spin_unlock(&rec_lock, key);
+}
+
+// Palauttaa i:nnen tapahtuman vanhimmasta lukien
+static struct rec_event ring_get(uint32_t i) {
+    uint32_t first = (rec_head + REC_SIZE - rec_count) % REC_SIZE;
+    return rec_ring[(first + i) % REC_SIZE];
+}
+
+void recorder_capture(uint8_t source, char payload) {
+    // Toiston aikana tallennus on pysäytetty, jotta kaappaus säilyy
+    if (replay_active) return;
+
+    struct rec_event ev = {
+        .us = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks()),
+        .source = source,
+        .payload = (uint8_t)payload,
+        .reserved = 0,
+    };
+    ring_put(&ev);
+}
+
+void recorder_clear(void) {
+    k_spinlock_key_t key = k_spin_lock(&rec_lock);
+    rec_head = 0;
+    rec_count = 0;
+    k_spin_unlock(&rec_lock, key);
+}
+
+// ---------------- DUMP / LOAD ----------------
+
+void recorder_dump(void) {
+    k_spinlock_key_t key = k_spin_lock(&rec_lock);
+    uint32_t count = rec_count;
+    k_spin_unlock(&rec_lock, key);
+
+    for (uint32_t i = 0; i < count; i++) {
+        struct rec_event ev = ring_get(i);
+        printk("RD %08x%02x%02x\n", ev.us, ev.source, ev.payload);
+    }
+    printk("RD END %u\n", count);
+}
+
+static int hex_field(const char *s, int n, uint32_t *out) {
+    uint32_t v = 0;
+    for (int i = 0; i < n; i++) {
+        char c = s[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= c - '0';
+        else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+        else return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+int recorder_load_hex(const char *hex) {
+    uint32_t us, source, payload;
+
+    if (!hex || strlen(hex) != REC_HEX_LEN) return -1;
+    if (hex_field(hex, 8, &us) || hex_field(hex + 8, 2, &source) ||
+        hex_field(hex + 10, 2, &payload)) {
+        return -1;
+    }
+
+    struct rec_event ev = {
+        .us = us,
+        .source = (uint8_t)source,
+        .payload = (uint8_t)payload,
+        .reserved = 0,
+    };
+    ring_put(&ev);
+    return 0;
+}
+
+// ---------------- LATENCY CLOCK ----------------
+
+#ifdef CONFIG_ARCH_POSIX
+// native_sim: simuloitu kello ei etene koodia ajettaessa, joten viive
+// luetaan isäntäkoneen kellosta (host_clock.c)
+extern uint64_t recorder_host_us(void);
+
+uint32_t recorder_stamp(void) {
+    return (uint32_t)recorder_host_us();
+}
+
+static uint32_t stamp_to_us(uint32_t stamp) {
+    return stamp;
+}
+#else
+uint32_t recorder_stamp(void) {
+    return k_cycle_get_32();
+}
+
+static uint32_t stamp_to_us(uint32_t stamp) {
+    return k_cyc_to_us_floor32(stamp);
+}
+#endif
+
+// ---------------- REPLAY ----------------
+
+int recorder_replay(bool realtime) {
+    if (replay_active) return -1;
+    replay_realtime = realtime;
+    k_sem_give(&replay_start_sem);
+    return 0;
+}
+
+void recorder_note_latency(uint8_t source, uint32_t ingest_stamp, uint32_t dequeue_stamp) {
+    if (source != REC_SRC_REPLAY) return;
+
+    uint32_t lat = recorder_stamp() - dequeue_stamp;
+    uint32_t queued = dequeue_stamp - ingest_stamp;
+    if (lat_count == 0 || lat < lat_min) lat_min = lat;
+    if (lat > lat_max) lat_max = lat;
+    if (queued > queue_max) queue_max = queued;
+    lat_sum += lat;
+    queue_sum += queued;
+    lat_count++;
+    k_sem_give(&replay_done_sem);
+}
+
+static void replay_report(uint32_t injected) {
+    if (lat_count == 0) {
+        printk("RP DONE %u/%u\n", lat_count, injected);
+        return;
+    }
+    printk("RP DONE %u/%u min %u us avg %u us max %u us queue avg %u us max %u us\n",
+           lat_count, injected,
+           stamp_to_us(lat_min),
+           stamp_to_us((uint32_t)(lat_sum / lat_count)),
+           stamp_to_us(lat_max),
+           stamp_to_us((uint32_t)(queue_sum / lat_count)),
+           stamp_to_us(queue_max));
+}
+
+void replay_task(void *, void *, void *) {
+    while (true) {
+        k_sem_take(&replay_start_sem, K_FOREVER);
+
+        replay_active = true;
+        k_sem_reset(&replay_done_sem);
+        lat_count = 0;
+        lat_min = 0;
+        lat_max = 0;
+        lat_sum = 0;
+        queue_max = 0;
+        queue_sum = 0;
+
+        uint32_t count = rec_count;
+        uint32_t injected = 0;
+        uint32_t prev = 0;
+
+        for (uint32_t i = 0; i < count; i++) {
+            struct rec_event ev = ring_get(i);
+            if (replay_realtime && i > 0) {
+                // Erotus on mikrosekunteja, joten pitkätkään tauot eivät
+                // vuoda yli kuten cycle-muunnoksessa
+                k_sleep(K_USEC(ev.us - prev));
+            }
+            prev = ev.us;
+            // Täysi jono ei saa pudottaa toistettavia tapahtumia
+            while (pipeline_submit(REC_SRC_REPLAY, (char)ev.payload) != 0) {
+                k_msleep(1);
+            }
+            injected++;
+        }
+
+        // Odotetaan että dispatcher on käsitellyt kaikki toistetut tapahtumat
+        for (uint32_t i = 0; i < injected; i++) {
+            if (k_sem_take(&replay_done_sem, K_MSEC(REPLAY_TIMEOUT_MS)) != 0) break;
+        }
+
+        replay_report(injected);
+        replay_active = false;
+    }
+}
+
+K_THREAD_DEFINE(replay_thread, REPLAY_STACK_SIZE, replay_task, NULL, NULL, NULL, PRIO_PARSER, 0, 0);
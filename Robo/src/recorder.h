@@ -0,0 +1,32 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Tapahtuman lähde pipelinessa
+#define REC_SRC_BUTTON 0
+#define REC_SRC_UART   1
+#define REC_SRC_REPLAY 2
+#define REC_SRC_SCHEDULE 3
+
+// Yksi tallennettu tapahtuma (8 tavua). Aikaleima on mikrosekunteina
+// käynnistyksestä, jotta eri kellotaajuudella kaapattu tallenne toistuu
+// oikealla ajoituksella (esim. nRF-kaappaus native_sim:llä).
+struct rec_event {
+    uint32_t us;
+    uint8_t source;
+    uint8_t payload;
+    uint16_t reserved;
+};
+
+void recorder_capture(uint8_t source, char payload);
+void recorder_clear(void);
+void recorder_dump(void);
+int recorder_load_hex(const char *hex);
+int recorder_replay(bool realtime);
+// Viiveleima: cycle-laskuri raudalla, isäntäkoneen µs native_sim:llä
+uint32_t recorder_stamp(void);
+void recorder_note_latency(uint8_t source, uint32_t ingest_stamp, uint32_t dequeue_stamp);
+
+#endif
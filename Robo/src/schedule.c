@@ -0,0 +1,209 @@
+// Valo-ohjelman paloittainen lataus ja suoritus
+//
+// Ohjelma ladataan UARTin yli paloina suoraan suorittajan toiseen
+// muistipankkiin, joten koko latausta ei puskuroida erikseen:
+//   #SB <askeleet>          aloittaa latauksen      -> SB OK <max>
+//   #SC <n> R,1000 Y,500 .. pala n (0, 1, 2, ...)   -> SC OK <n> <yht.>
+//   #SE <askeleet>          ottaa ohjelman käyttöön -> SE OK <askeleet>
+//   #SA                     keskeyttää latauksen    -> SA OK
+//   #SX                     pysäyttää ohjelman      -> SX OK
+// Jokainen pala tarkistetaan kokonaan ennen kuin sen askeleet hyväksytään.
+// Virheellinen pala hylätään ("SC ERR <n> <syy>") ja sen voi lähettää
+// uudelleen samalla numerolla. Pankki vaihdetaan vasta #SE:ssä yhdellä
+// lukitulla sijoituksella, ja suoritus jatkuu uuden ohjelman alusta
+// seuraavan askeleen rajalla.
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "schedule.h"
+#include "pipeline.h"
+#include "priorities.h"
+#include "recorder.h"
+
+#define SCHED_MAX_STEPS CONFIG_APP_SCHEDULE_MAX_STEPS
+#define SCHED_STACK_SIZE 768
+
+static struct sched_step banks[2][SCHED_MAX_STEPS];
+static struct k_spinlock sched_lock;
+
+// Suorittajan tila, muutetaan vain sched_lockin alla
+static uint8_t active_bank;
+static uint32_t active_len;
+static uint32_t active_gen;
+
+// Lataustila, käytetään vain UART-säikeestä
+static bool upload_open;
+static uint32_t upload_total;
+static uint32_t upload_len;
+static uint32_t upload_seq;
+
+K_SEM_DEFINE(sched_run_sem, 0, 1);
+K_SEM_DEFINE(sched_step_sem, 0, 1);
+
+// ---------------- UPLOAD ----------------
+
+static const char *parse_step(const char *p, struct sched_step *step) {
+    char color = *p++;
+    if (color >= 'a' && color <= 'z') color = color - 'a' + 'A';
+    if (color != 'R' && color != 'Y' && color != 'G') return NULL;
+    if (*p++ != ',') return NULL;
+
+    char *end;
+    unsigned long duration = strtoul(p, &end, 10);
+    if (end == p || duration == 0 || duration > UINT16_MAX) return NULL;
+    if (*end != ' ' && *end != '\0') return NULL;
+
+    step->color = color;
+    step->duration_ms = (uint16_t)duration;
+    step->reserved = 0;
+    return end;
+}
+
+static uint8_t upload_bank(void) {
+    // Lataus menee aina pankkiin, jota suorittaja ei käytä
+    return active_bank ^ 1;
+}
+
+static void upload_begin(const char *arg) {
+    unsigned long total = strtoul(arg, NULL, 10);
+
+    if (total == 0 || total > SCHED_MAX_STEPS) {
+        printk("SB ERR %d\n", SCHED_MAX_STEPS);
+        return;
+    }
+    upload_open = true;
+    upload_total = total;
+    upload_len = 0;
+    upload_seq = 0;
+    printk("SB OK %d\n", SCHED_MAX_STEPS);
+}
+
+static void upload_chunk(const char *arg) {
+    char *p;
+    unsigned long seq = strtoul(arg, &p, 10);
+
+    if (!upload_open) {
+        printk("SC ERR %lu OPEN\n", seq);
+        return;
+    }
+    if (p == arg || seq != upload_seq) {
+        printk("SC ERR %lu SEQ %u\n", seq, upload_seq);
+        return;
+    }
+
+    // Askeleet kirjoitetaan suoraan pankkiin, mutta upload_len siirtyy
+    // vasta kun koko pala on kelvollinen
+    struct sched_step *bank = banks[upload_bank()];
+    uint32_t len = upload_len;
+    const char *s = p;
+
+    while (*s == ' ') s++;
+    while (*s != '\0') {
+        if (len >= upload_total) {
+            printk("SC ERR %lu FULL\n", seq);
+            return;
+        }
+        s = parse_step(s, &bank[len]);
+        if (!s) {
+            printk("SC ERR %lu STEP %u\n", seq, len - upload_len);
+            return;
+        }
+        len++;
+        while (*s == ' ') s++;
+    }
+
+    upload_len = len;
+    upload_seq++;
+    printk("SC OK %lu %u\n", seq, upload_len);
+}
+
+static void upload_end(const char *arg) {
+    unsigned long total = strtoul(arg, NULL, 10);
+
+    if (!upload_open || total != upload_total || upload_len != upload_total) {
+        printk("SE ERR %u/%u\n", upload_len, upload_total);
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&sched_lock);
+    active_bank = upload_bank();
+    active_len = upload_len;
+    active_gen++;
+    k_spin_unlock(&sched_lock, key);
+
+    upload_open = false;
+    k_sem_give(&sched_run_sem);
+    printk("SE OK %u\n", active_len);
+}
+
+static void schedule_stop(void) {
+    k_spinlock_key_t key = k_spin_lock(&sched_lock);
+    active_len = 0;
+    active_gen++;
+    k_spin_unlock(&sched_lock, key);
+    printk("SX OK\n");
+}
+
+void schedule_command(const char *cmd) {
+    if (strncmp(cmd, "SB ", 3) == 0) {
+        upload_begin(cmd + 3);
+    } else if (strncmp(cmd, "SC ", 3) == 0) {
+        upload_chunk(cmd + 3);
+    } else if (strncmp(cmd, "SE ", 3) == 0) {
+        upload_end(cmd + 3);
+    } else if (strcmp(cmd, "SA") == 0) {
+        upload_open = false;
+        printk("SA OK\n");
+    } else if (strcmp(cmd, "SX") == 0) {
+        schedule_stop();
+    } else {
+        printk("Unknown command: %s\n", cmd);
+    }
+}
+
+// ---------------- EXECUTOR ----------------
+
+void schedule_step_done(void) {
+    k_sem_give(&sched_step_sem);
+}
+
+void schedule_task(void *, void *, void *) {
+    uint32_t gen = 0;
+    uint32_t idx = 0;
+
+    while (true) {
+        struct sched_step step;
+        bool have_step = false;
+
+        k_spinlock_key_t key = k_spin_lock(&sched_lock);
+        if (gen != active_gen) {
+            gen = active_gen;
+            idx = 0;
+        }
+        if (active_len > 0) {
+            step = banks[active_bank][idx];
+            idx = (idx + 1) % active_len;
+            have_step = true;
+        }
+        k_spin_unlock(&sched_lock, key);
+
+        if (!have_step) {
+            k_sem_take(&sched_run_sem, K_FOREVER);
+            continue;
+        }
+
+        // Odotetaan paikkaa jonossa ja sitten askeleen valmistumista,
+        // jotta uusi ohjelma tulee voimaan heti seuraavasta askeleesta
+        while (pipeline_submit_step(REC_SRC_SCHEDULE, step.color, step.duration_ms) != 0) {
+            k_msleep(10);
+        }
+        // Ei aikarajaa: jonossa voi olla edellä useita nappi- ja UART-askeleita,
+        // ja myöhästynyt kuittaus laskettaisiin binäärisemaforilla seuraavalle
+        // askeleelle. Dispatcher kuittaa jokaisen ohjelman alkion.
+        k_sem_take(&sched_step_sem, K_FOREVER);
+    }
+}
+
+K_THREAD_DEFINE(schedule_thread, SCHED_STACK_SIZE, schedule_task, NULL, NULL, NULL, PRIO_DISPATCHER, 0, 0);
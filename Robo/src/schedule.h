@@ -0,0 +1,16 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdint.h>
+
+// Yksi ohjelman askel (4 tavua)
+struct sched_step {
+    uint16_t duration_ms;
+    char color;
+    uint8_t reserved;
+};
+
+void schedule_command(const char *cmd);
+void schedule_step_done(void);
+
+#endif
@@ -0,0 +1,59 @@
+// Keskeytysohjattu UART-vastaanotto
+//
+// ISR siirtää vastaanotetut tavut rengaspuskuriin ja herättää lukijan,
+// joten UART-säie nukkuu kunnes dataa tulee eikä pollaa. Kun puskuri on
+// lähes täynnä, RX-keskeytys pysäytetään: laitteiston FIFO täyttyy ja
+// RTS pysäyttää isännän, kunnes lukija on vapauttanut tilaa.
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <errno.h>
+
+#include "uart_rx.h"
+
+#define RX_CHUNK 16
+
+RING_BUF_DECLARE(rx_ring, CONFIG_APP_UART_RX_BUF_SIZE);
+K_SEM_DEFINE(rx_sem, 0, 1);
+
+static const struct device *rx_dev;
+static volatile bool rx_paused;
+
+static void rx_isr(const struct device *dev, void *user_data) {
+    uint8_t buf[RX_CHUNK];
+
+    if (!uart_irq_update(dev)) return;
+
+    while (uart_irq_rx_ready(dev)) {
+        if (ring_buf_space_get(&rx_ring) < RX_CHUNK) {
+            uart_irq_rx_disable(dev);
+            rx_paused = true;
+            break;
+        }
+        int n = uart_fifo_read(dev, buf, RX_CHUNK);
+        if (n <= 0) break;
+        ring_buf_put(&rx_ring, buf, n);
+    }
+    k_sem_give(&rx_sem);
+}
+
+int uart_rx_init(const struct device *dev) {
+    int ret = uart_irq_callback_user_data_set(dev, rx_isr, NULL);
+    if (ret != 0) return ret;
+
+    rx_dev = dev;
+    uart_irq_rx_enable(dev);
+    return 0;
+}
+
+int uart_rx_get(unsigned char *c, k_timeout_t timeout) {
+    while (ring_buf_get(&rx_ring, c, 1) == 0) {
+        if (k_sem_take(&rx_sem, timeout) != 0) return -EAGAIN;
+    }
+    // ISR ei aja kun RX on pysäytetty, joten lippua ei tarvitse lukita
+    if (rx_paused && ring_buf_space_get(&rx_ring) >= RX_CHUNK) {
+        rx_paused = false;
+        uart_irq_rx_enable(rx_dev);
+    }
+    return 0;
+}
@@ -0,0 +1,10 @@
+#ifndef UART_RX_H
+#define UART_RX_H
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+
+int uart_rx_init(const struct device *dev);
+int uart_rx_get(unsigned char *c, k_timeout_t timeout);
+
+#endif
@@ -0,0 +1,87 @@
+// UARTin nopeuden vaihto ajon aikana
+//
+// Isäntä pyytää "#BAUD <nopeus>", laite vastaa "BAUD ACK <nopeus>" vanhalla
+// nopeudella ja vaihtaa uuteen nopeuteen RTS/CTS-vuonohjauksella. Isäntä
+// vaihtaa omansa ja lähettää "#BAUD OK", johon laite vastaa uudella
+// nopeudella "BAUD OK <nopeus>". Jos vahvistusta ei tule ajoissa, laite
+// palaa alkuperäiseen asetukseen (115200) ja tulostaa "BAUD TIMEOUT".
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/drivers/uart.h>
+#include <errno.h>
+#include <string.h>
+
+#include "uart_speed.h"
+#include "uart_rx.h"
+
+#define UART_DEFAULT_BAUD 115200
+#define UART_TX_DRAIN_MS 5
+#define UART_CONFIRM_LEN 16
+
+static struct uart_config default_cfg = {
+    .baudrate = UART_DEFAULT_BAUD,
+    .parity = UART_CFG_PARITY_NONE,
+    .stop_bits = UART_CFG_STOP_BITS_1,
+    .data_bits = UART_CFG_DATA_BITS_8,
+    .flow_ctrl = UART_CFG_FLOW_CTRL_NONE,
+};
+int uart_speed_init(const struct device *dev) {
+    // Lähtöasetus talteen, jotta paluu ei riipu devicetreestä
+    return uart_config_get(dev, &default_cfg);
+}
+
+void uart_speed_reset(const struct device *dev) {
+    k_msleep(UART_TX_DRAIN_MS);
+    uart_configure(dev, &default_cfg);
+}
+
+static int wait_confirm(void) {
+    char line[UART_CONFIRM_LEN];
+    int len = 0;
+    unsigned char c;
+    int64_t deadline = k_uptime_get() + CONFIG_APP_UART_BAUD_TIMEOUT_MS;
+    int64_t left;
+
+    while ((left = deadline - k_uptime_get()) > 0) {
+        if (uart_rx_get(&c, K_MSEC(left)) != 0) break;
+        if (c == '\r' || c == '\n') {
+            line[len] = '\0';
+            if (strcmp(line, UART_SPEED_CONFIRM) == 0) return 0;
+            len = 0;
+        } else if (len < UART_CONFIRM_LEN - 1) {
+            line[len++] = c;
+        }
+    }
+    return -ETIMEDOUT;
+}
+
+int uart_speed_switch(const struct device *dev, uint32_t baud) {
+    if (baud < UART_DEFAULT_BAUD || baud > CONFIG_APP_UART_MAX_BAUD) {
+        printk("BAUD ERR %u\n", baud);
+        return -EINVAL;
+    }
+
+    struct uart_config cfg = default_cfg;
+    cfg.baudrate = baud;
+    cfg.flow_ctrl = UART_CFG_FLOW_CTRL_RTS_CTS;
+
+    printk("BAUD ACK %u\n", baud);
+    k_msleep(UART_TX_DRAIN_MS);
+
+    int ret = uart_configure(dev, &cfg);
+    if (ret != 0) {
+        uart_speed_reset(dev);
+        printk("BAUD ERR %d\n", ret);
+        return ret;
+    }
+
+    ret = wait_confirm();
+    if (ret != 0) {
+        uart_speed_reset(dev);
+        printk("BAUD TIMEOUT\n");
+        return ret;
+    }
+
+    printk("BAUD OK %u\n", baud);
+    return 0;
+}
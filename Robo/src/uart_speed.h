@@ -0,0 +1,15 @@
+#ifndef UART_SPEED_H
+#define UART_SPEED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/device.h>
+
+// Isäntä vahvistaa uuden nopeuden lähettämällä tämän rivin
+#define UART_SPEED_CONFIRM "#BAUD OK"
+
+int uart_speed_init(const struct device *dev);
+int uart_speed_switch(const struct device *dev, uint32_t baud);
+void uart_speed_reset(const struct device *dev);
+
+#endif
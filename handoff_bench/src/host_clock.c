@@ -0,0 +1,9 @@
+// native_sim: isäntäpuolen kello benchmarkille (käännetään native_simulatoriin)
+#include <stdint.h>
+#include <time.h>
+
+uint64_t bench_host_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
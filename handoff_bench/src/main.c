@@ -0,0 +1,318 @@
+// Dispatcher -> worker luovutuksen benchmark
+//
+// Mittaa saman kuvion kuin Robo ja viikot 2-4: dispatcher antaa workerille
+// keston, worker kuittaa release_semillä ja dispatcher odottaa kuittausta.
+// Luovutusprimitiivi vaihtuu (semafori, condvar, k_msgq, k_event, k_pipe,
+// lukoton SPSC-rengas), kuittaus on aina sama binäärisemafori. Jokainen
+// primitiivi ajetaan kahdella prioriteettiprofiililla: "flat" (molemmat 5,
+// viikkojen 2-4 ohjain) ja "tiered" (Robon priorities.h: dispatcher
+// PRIO_DISPATCHER, worker LED-työjonon tasolla PRIO_LED).
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#ifndef CONFIG_ARCH_POSIX
+#include <zephyr/timing/timing.h>
+#endif
+#include <string.h>
+
+#include "priorities.h"
+
+#define STACKSIZE 1024
+#define PRIORITY 5
+#define ITERATIONS 1000
+
+#define SPSC_SIZE 8
+#define EVENT_JOB BIT(0)
+
+K_THREAD_STACK_DEFINE(dispatcher_stack, STACKSIZE);
+K_THREAD_STACK_DEFINE(worker_stack, STACKSIZE);
+static struct k_thread dispatcher_thread;
+static struct k_thread worker_thread;
+
+K_SEM_DEFINE(release_sem, 0, 1);
+
+struct handoff_ops {
+    const char *name;
+    void (*reset)(void);
+    void (*send)(uint32_t duration);
+    uint32_t (*recv)(void);
+    // Worker pollaa eikä nuku: ei toimi, jos worker on dispatcheria kiireellisempi
+    bool polls;
+};
+
+struct prio_profile {
+    const char *name;
+    int dispatcher;
+    int worker;
+};
+
+static const struct prio_profile profiles[] = {
+    {"flat", PRIORITY, PRIORITY},
+    {"tiered", PRIO_DISPATCHER, PRIO_LED},
+};
+
+static const struct handoff_ops *ops;
+
+static volatile uint64_t t_send;
+static uint64_t lat_min;
+static uint64_t lat_max;
+static uint64_t lat_sum;
+static uint32_t errors;
+
+// ---------------- CLOCK ----------------
+
+#ifdef CONFIG_ARCH_POSIX
+extern uint64_t bench_host_ns(void);
+
+static uint64_t now_ns(void) {
+    return bench_host_ns();
+}
+#else
+static timing_t t_base;
+
+static uint64_t now_ns(void) {
+    timing_t t = timing_counter_get();
+    return timing_cycles_to_ns(timing_cycles_get(&t_base, &t));
+}
+#endif
+
+// ---------------- SEMAPHORE (Robo, viikko 4) ----------------
+
+K_SEM_DEFINE(job_sem, 0, 1);
+static uint32_t sem_duration;
+
+static void sem_reset(void) {
+    k_sem_reset(&job_sem);
+}
+
+static void sem_send(uint32_t duration) {
+    sem_duration = duration;
+    k_sem_give(&job_sem);
+}
+
+static uint32_t sem_recv(void) {
+    k_sem_take(&job_sem, K_FOREVER);
+    return sem_duration;
+}
+
+// ---------------- MUTEX + CONDVAR (viikko 2/3) ----------------
+
+// Kesto kulkee jaetussa muuttujassa mutexin alla ja pending-lippu estää
+// kadonneen signaalin, jos worker ei vielä odota condvaria.
+K_MUTEX_DEFINE(job_mutex);
+K_CONDVAR_DEFINE(job_cv);
+static uint32_t cv_duration;
+static bool cv_pending;
+
+static void cv_reset(void) {
+    cv_pending = false;
+}
+
+static void cv_send(uint32_t duration) {
+    k_mutex_lock(&job_mutex, K_FOREVER);
+    cv_duration = duration;
+    cv_pending = true;
+    k_condvar_signal(&job_cv);
+    k_mutex_unlock(&job_mutex);
+}
+
+static uint32_t cv_recv(void) {
+    k_mutex_lock(&job_mutex, K_FOREVER);
+    while (!cv_pending) {
+        k_condvar_wait(&job_cv, &job_mutex, K_FOREVER);
+    }
+    cv_pending = false;
+    uint32_t duration = cv_duration;
+    k_mutex_unlock(&job_mutex);
+    return duration;
+}
+
+// ---------------- K_MSGQ ----------------
+
+K_MSGQ_DEFINE(job_msgq, sizeof(uint32_t), 1, 4);
+
+static void msgq_reset(void) {
+    k_msgq_purge(&job_msgq);
+}
+
+static void msgq_send(uint32_t duration) {
+    k_msgq_put(&job_msgq, &duration, K_FOREVER);
+}
+
+static uint32_t msgq_recv(void) {
+    uint32_t duration;
+    k_msgq_get(&job_msgq, &duration, K_FOREVER);
+    return duration;
+}
+
+// ---------------- K_EVENT ----------------
+
+K_EVENT_DEFINE(job_event);
+static uint32_t event_duration;
+
+static void event_reset(void) {
+    k_event_clear(&job_event, EVENT_JOB);
+}
+
+static void event_send(uint32_t duration) {
+    event_duration = duration;
+    k_event_post(&job_event, EVENT_JOB);
+}
+
+static uint32_t event_recv(void) {
+    k_event_wait(&job_event, EVENT_JOB, false, K_FOREVER);
+    k_event_clear(&job_event, EVENT_JOB);
+    return event_duration;
+}
+
+// ---------------- K_PIPE ----------------
+
+// Zephyr 4.1:n k_pipe_write/k_pipe_read. Vanhempi Zephyr tarvitsee
+// CONFIG_PIPES=y ja vanhan k_pipe_put/k_pipe_get-rajapinnan.
+K_PIPE_DEFINE(job_pipe, 16, 4);
+
+static void pipe_reset(void) {
+}
+
+#ifdef CONFIG_PIPES
+static void pipe_send(uint32_t duration) {
+    size_t written;
+    k_pipe_put(&job_pipe, &duration, sizeof(duration), &written, sizeof(duration), K_FOREVER);
+}
+
+static uint32_t pipe_recv(void) {
+    uint32_t duration;
+    size_t read;
+    k_pipe_get(&job_pipe, &duration, sizeof(duration), &read, sizeof(duration), K_FOREVER);
+    return duration;
+}
+#else
+static void pipe_send(uint32_t duration) {
+    k_pipe_write(&job_pipe, (const uint8_t *)&duration, sizeof(duration), K_FOREVER);
+}
+
+static uint32_t pipe_recv(void) {
+    uint32_t duration;
+    k_pipe_read(&job_pipe, (uint8_t *)&duration, sizeof(duration), K_FOREVER);
+    return duration;
+}
+#endif
+
+// ---------------- LOCK-FREE SPSC RING ----------------
+
+// Yksi tuottaja, yksi kuluttaja. Worker pollaa k_yield():llä, koska
+// herätys semaforilla tekisi tästä taas semaforitestin.
+static uint32_t spsc_buf[SPSC_SIZE];
+static volatile uint32_t spsc_head;
+static volatile uint32_t spsc_tail;
+
+static void spsc_reset(void) {
+    spsc_head = 0;
+    spsc_tail = 0;
+}
+
+static void spsc_send(uint32_t duration) {
+    while (spsc_head - spsc_tail == SPSC_SIZE) {
+        k_yield();
+    }
+    spsc_buf[spsc_head % SPSC_SIZE] = duration;
+    barrier_dmem_fence_full();
+    spsc_head = spsc_head + 1;
+}
+
+static uint32_t spsc_recv(void) {
+    while (spsc_tail == spsc_head) {
+        k_yield();
+    }
+    barrier_dmem_fence_full();
+    uint32_t duration = spsc_buf[spsc_tail % SPSC_SIZE];
+    spsc_tail = spsc_tail + 1;
+    return duration;
+}
+
+static const struct handoff_ops handoffs[] = {
+    {"sem", sem_reset, sem_send, sem_recv, false},
+    {"condvar", cv_reset, cv_send, cv_recv, false},
+    {"msgq", msgq_reset, msgq_send, msgq_recv, false},
+    {"event", event_reset, event_send, event_recv, false},
+    {"pipe", pipe_reset, pipe_send, pipe_recv, false},
+    {"spsc", spsc_reset, spsc_send, spsc_recv, true},
+};
+
+// ---------------- THREADS ----------------
+
+static void worker_task(void *, void *, void *) {
+    for (uint32_t i = 1; i <= ITERATIONS; i++) {
+        uint32_t duration = ops->recv();
+        uint64_t lat = now_ns() - t_send;
+
+        if (duration != i) errors++;
+        if (lat < lat_min) lat_min = lat;
+        if (lat > lat_max) lat_max = lat;
+        lat_sum += lat;
+
+        k_sem_give(&release_sem);
+    }
+}
+
+static void dispatcher_task(void *, void *, void *) {
+    for (uint32_t i = 1; i <= ITERATIONS; i++) {
+        t_send = now_ns();
+        ops->send(i);
+        k_sem_take(&release_sem, K_FOREVER);
+    }
+}
+
+static void run_one(const struct handoff_ops *o, const struct prio_profile *prio) {
+    // k_yield() luovuttaa vain saman tai kiireellisemmän prioriteetin säikeelle,
+    // joten kiireellisempi polleava worker ei koskaan päästäisi dispatcheria ajoon
+    if (o->polls && prio->worker < prio->dispatcher) {
+        printk("%-8s skipped: polling worker starves the dispatcher\n", o->name);
+        return;
+    }
+
+    ops = o;
+    ops->reset();
+    k_sem_reset(&release_sem);
+    lat_min = UINT64_MAX;
+    lat_max = 0;
+    lat_sum = 0;
+    errors = 0;
+
+    uint64_t start = now_ns();
+    k_thread_create(&worker_thread, worker_stack, K_THREAD_STACK_SIZEOF(worker_stack),
+                    worker_task, NULL, NULL, NULL, prio->worker, 0, K_NO_WAIT);
+    k_thread_create(&dispatcher_thread, dispatcher_stack, K_THREAD_STACK_SIZEOF(dispatcher_stack),
+                    dispatcher_task, NULL, NULL, NULL, prio->dispatcher, 0, K_NO_WAIT);
+    k_thread_join(&dispatcher_thread, K_FOREVER);
+    k_thread_join(&worker_thread, K_FOREVER);
+    uint64_t total = now_ns() - start;
+
+    printk("%-8s lat min %6llu avg %6llu max %8llu ns  %7llu handoffs/s  errors %u\n",
+           ops->name, lat_min, lat_sum / ITERATIONS, lat_max,
+           total ? (uint64_t)ITERATIONS * 1000000000ull / total : 0, errors);
+}
+
+// ---------------- MAIN ----------------
+
+int main(void) {
+#ifndef CONFIG_ARCH_POSIX
+    timing_init();
+    timing_start();
+    t_base = timing_counter_get();
+#endif
+
+    printk("Handoff benchmark: %d iterations\n", ITERATIONS);
+    for (int p = 0; p < ARRAY_SIZE(profiles); p++) {
+        printk("Profile %s: dispatcher %d, worker %d\n",
+               profiles[p].name, profiles[p].dispatcher, profiles[p].worker);
+        for (int i = 0; i < ARRAY_SIZE(handoffs); i++) {
+            run_one(&handoffs[i], &profiles[p]);
+        }
+    }
+    printk("Handoff benchmark done\n");
+
+#ifndef CONFIG_ARCH_POSIX
+    timing_stop();
+#endif
+    return 0;
+}